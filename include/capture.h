@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chip8.h"
+
+#define CAPTURE_MAGIC "C8CV"
+#define CAPTURE_VERSION 1
+
+typedef std::array<bool, SCREEN_HEIGHT * SCREEN_WIDTH> Frame;
+
+// Capture file format, after a header of magic, version, width and height (1 byte each):
+// every record is the time since the previous record in ms (LEB128 varint) followed by the frame, XORed with the
+// previous frame and run length encoded as alternating unchanged/changed runs (also varints) covering every pixel.
+// The first frame is XORed against a blank screen. A record that changes nothing marks the end of the session,
+// so the last frame's duration is known.
+
+// Records presented frames in the background. capture() is called from the emulation thread and only
+// compares against the last frame and queues a copy when something changed; encoding and I/O happen on the writer thread.
+// The queue is unbounded so no frame is ever dropped. There's at most one frame per draw instruction (CPU_SPEED a second)
+// at 2K each, so a writer stalled on a slow disk costs at most about 1M of memory per second until it catches up.
+class FrameRecorder {
+    public:
+        ~FrameRecorder();
+
+        bool start(std::string path);
+        bool stop(); // Returns false if anything failed to write
+        void capture(const Frame& frame);
+
+    private:
+        struct PendingFrame {
+            uint32_t timestamp_ms;
+            Frame frame;
+        };
+
+        // Fields
+        bool recording {false};
+        Frame last_frame {};
+        std::chrono::steady_clock::time_point start_time;
+        // The buffer must outlive the stream, which flushes into the file from it on destruction.
+        std::array<char, 1 << 16> buffer;
+        std::ofstream file_stream;
+        std::thread writer_thread;
+
+        // Guarded by mutex
+        std::mutex mutex;
+        std::condition_variable frames_ready;
+        std::vector<PendingFrame> queue;
+        bool stopping {false};
+
+        // Methods
+        void run_writer();
+};
+
+// Decodes a capture file one frame at a time.
+class FrameReader {
+    public:
+        FrameReader(std::string path);
+
+        // Returns false once the end of the session is reached, at which point get_end_time() is valid.
+        bool next(Frame& frame, uint32_t& timestamp_ms);
+        uint32_t get_end_time() const { return timestamp_ms; }
+
+    private:
+        std::ifstream file_stream;
+        Frame frame {};
+        uint32_t timestamp_ms {0};
+
+        bool read_varint(uint32_t& value);
+};
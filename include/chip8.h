@@ -1,8 +1,8 @@
 #pragma once
 
-#include <stack>
 #include <array>
 #include <string>
+#include <random>
 
 #include <SDL2/SDL.h>
 
@@ -15,19 +15,57 @@
 #define SOUND_SPEED 60
 #define CPU_SPEED 500
 
+#define ADDRESS_MASK 0xFFF
+#define STACK_SIZE 16
+
+// Conditions that would be out of bounds on real hardware (and undefined behaviour in this interpreter).
+// Addresses are always masked to 12 bits, so by default these are survivable and execution carries on.
+// In hardened mode the first fault halts the CPU instead, without executing the faulting instruction.
+enum class Chip8Fault {
+    None,
+    StackOverflow,
+    StackUnderflow,
+    PcOutOfBounds,
+    MemoryOutOfBounds,
+    UnknownOpcode,
+};
+
+const char* describe_fault(Chip8Fault fault);
 
 class Chip8 {
+    friend class GdbServer;
+
     public:
         bool draw_flag;
         Keyboard keyboard;
         void perform_cycle();
+        void execute_instruction();
         void load_font();
         void load_rom(std::string rom_name);
+        void load_rom_data(const uint8_t* data, size_t size);
         void print_memory();
         void draw_screen(SDL_Renderer* renderer_ptr);
         void update_timer(double delta);
+        void seed_random(uint32_t seed);
+        uint16_t get_next_op_code() const;
+        void set_hardened(bool enabled);
         Chip8();
 
+        // The first fault seen and the address of the instruction that caused it.
+        Chip8Fault get_fault() const { return fault; }
+        uint16_t get_fault_pc() const { return fault_pc; }
+        bool is_halted() const { return hardened && fault != Chip8Fault::None; }
+
+        // Read-only views of the machine state, used by the trace tooling.
+        uint16_t get_pc() const { return pc; }
+        uint16_t get_I() const { return I; }
+        uint8_t get_sp() const { return sp; }
+        uint8_t get_delay_timer() const { return delay_timer; }
+        uint8_t get_sound_timer() const { return sound_timer; }
+        const std::array<uint8_t, 16>& get_registers() const { return V; }
+        const std::array<uint8_t, 4096>& get_memory() const { return memory; }
+        const std::array<bool, SCREEN_HEIGHT * SCREEN_WIDTH>& get_gfx() const { return gfx; }
+
     private:
         // Fields
         uint16_t pc {0x200}; // Program Counter
@@ -39,11 +77,17 @@ class Chip8 {
         std::array<uint8_t, 4096> memory {}; // 4K of memory
         std::array<uint8_t, 16> V {};  // 16 CPU registers. 15 general purpose registers and carry flag
         std::array<bool, SCREEN_HEIGHT * SCREEN_WIDTH> gfx {}; // GFX Buffer
-        std::stack<uint16_t> stack;
+        std::array<uint16_t, STACK_SIZE> stack {};
+        uint8_t sp {0}; // Stack pointer, the number of return addresses on the stack
+        std::mt19937 rng {std::random_device{}()};
+        bool hardened {false};
+        Chip8Fault fault {Chip8Fault::None};
+        uint16_t fault_pc {0};
+        bool unknown_opcode_reported {false};
 
         // Methods
         inline void increment_pc();
-        uint16_t get_next_op_code();
+        inline bool check_fault(bool valid, Chip8Fault kind);
         void set_delay_timer(uint8_t time);
         void set_sound_timer(uint8_t time);
 
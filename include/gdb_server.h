@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "chip8.h"
+
+// A GDB remote serial protocol (RSP) stub listening on a localhost TCP port.
+//
+// The socket is owned by a background I/O thread. The emulation thread only calls service() once per cycle,
+// which is a single atomic load while no client is attached. While a client is attached the CPU is halted on
+// connect, on breakpoints, after a single step and on an interrupt (Ctrl-C). Packets that touch registers or
+// memory are only accepted while the CPU is halted, so the I/O thread never races with perform_cycle(). On connect
+// the I/O thread only requests a halt and waits for the emulation thread to acknowledge it before serving packets.
+//
+// Register layout (as reported in target.xml): V0..VF (8 bit), I (16 bit), pc (16 bit), sp, dt and st (8 bit).
+class GdbServer {
+    public:
+        GdbServer(Chip8& chip);
+        ~GdbServer();
+
+        bool start(uint16_t port);
+        void stop();
+
+        // Returns true if the CPU may execute the next instruction.
+        inline bool service() {
+            if (!attached.load(std::memory_order_acquire)) {
+                return true;
+            }
+            return service_attached();
+        }
+
+    private:
+        // Fields
+        Chip8& chip;
+        int listen_fd {-1};
+        int client_fd {-1};
+        std::thread io_thread;
+        std::atomic<bool> attached {false};
+        std::atomic<bool> stopping {false};
+
+        // Everything below is guarded by mutex.
+        std::mutex mutex;
+        std::condition_variable resumed;
+        std::condition_variable halt_acknowledged;
+        bool halted {false};
+        bool halt_requested {false};
+        bool interrupt_requested {false};
+        bool stepping {false};
+        bool step_taken {false};
+        bool skip_breakpoint {false};
+        std::array<bool, 4096> breakpoints {};
+
+        // Methods
+        bool service_attached();
+        void run_io_loop();
+        void serve_client();
+        void attach(int fd);
+        void detach();
+
+        void handle_packet(const std::string& packet);
+        std::string handle_query(const std::string& packet);
+        std::string read_registers();
+        std::string read_register(unsigned int reg);
+        bool write_register(unsigned int reg, uint16_t value);
+        std::string read_memory(const std::string& args);
+        std::string write_memory(const std::string& args);
+        std::string set_breakpoint(const std::string& args, bool enabled);
+        void resume(const std::string& args, bool step);
+
+        void send_packet(const std::string& payload);
+        void send_raw(const std::string& data);
+        void send_stop_reply(int signal);
+};
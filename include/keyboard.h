@@ -11,9 +11,11 @@ class Keyboard {
         bool is_key_up(uint8_t key);
         uint8_t await_key_press();
         void remap_key(uint8_t chip_key, SDL_Scancode);
+        void set_virtual_key(uint8_t key, bool down);
 
     private:
         std::array<bool, 16> get_key_state();
+        std::array<bool, 16> virtual_keys {}; // Keys held down by something other than the keyboard, e.g. tests
         std::array<SDL_Scancode, 16> key_map {
             SDL_SCANCODE_X,
             SDL_SCANCODE_1,
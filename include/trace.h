@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "chip8.h"
+
+#define TRACE_MAGIC "C8TR"
+#define TRACE_VERSION 1
+#define TRACE_RECORD_SIZE 36 // Bytes per record on disk, see TraceRecord
+
+// The machine state after executing a single instruction.
+// On disk every field is stored little endian, in declaration order, with no padding.
+struct TraceRecord {
+    uint32_t step;
+    uint16_t pc; // Address the instruction was fetched from
+    uint16_t opcode;
+    uint16_t I;
+    uint8_t sp;
+    uint8_t delay_timer;
+    std::array<uint8_t, 16> V;
+    uint64_t gfx_hash;
+
+    bool operator==(const TraceRecord& other) const;
+    bool operator!=(const TraceRecord& other) const { return !(*this == other); }
+};
+
+std::string format_trace_record(const TraceRecord& record);
+uint64_t hash_gfx(const std::array<bool, SCREEN_HEIGHT * SCREEN_WIDTH>& gfx);
+
+// Anything that can produce a stream of trace records, one at a time.
+class TraceSource {
+    public:
+        virtual ~TraceSource() {};
+        virtual bool next(TraceRecord& record) = 0;
+        virtual std::string name() const = 0;
+};
+
+// Reads a recorded trace file. Only one record is held in memory at a time.
+class TraceReader : public TraceSource {
+    public:
+        TraceReader(std::string path);
+        bool next(TraceRecord& record) override;
+        std::string name() const override { return path; }
+
+    private:
+        std::string path;
+        std::ifstream file_stream;
+};
+
+class TraceWriter {
+    public:
+        TraceWriter(std::string path);
+        void write(const TraceRecord& record);
+        bool close(); // Returns false if anything failed to write
+
+    private:
+        // The buffer must outlive the stream, which flushes into the file from it on destruction.
+        std::array<char, 1 << 16> buffer;
+        std::ofstream file_stream;
+};
+
+// Runs a ROM on the reference interpreter and emits a record for every instruction executed.
+// Timers are advanced by a fixed amount per instruction and the RNG is seeded, so runs are reproducible.
+// The run ends after max_steps instructions, or at the first FX0A since there's nobody to press a key.
+class CoreTraceSource : public TraceSource {
+    public:
+        CoreTraceSource(std::string rom_name, uint32_t max_steps, uint32_t seed);
+        bool next(TraceRecord& record) override;
+        std::string name() const override { return rom_name; }
+
+    private:
+        Chip8 chip;
+        std::string rom_name;
+        uint32_t max_steps;
+        uint32_t step {0};
+        uint64_t gfx_hash;
+};
+
+bool is_trace_file(std::string path);
@@ -0,0 +1,182 @@
+#include <iostream>
+#include <cstring>
+
+#include "capture.h"
+
+static void write_varint(std::ofstream& file_stream, uint32_t value) {
+    while (value >= 0x80) {
+        file_stream.put((char) ((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    file_stream.put((char) value);
+}
+
+//  ---------- Recording ----------
+FrameRecorder::~FrameRecorder() {
+    stop();
+}
+
+bool FrameRecorder::start(std::string path) {
+    file_stream.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file_stream.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file_stream.is_open()) {
+        std::cerr << "Error opening " << path << " for recording" << std::endl;
+        return false;
+    }
+
+    char header[7] = {'C', '8', 'C', 'V', CAPTURE_VERSION, SCREEN_WIDTH, SCREEN_HEIGHT};
+    file_stream.write(header, sizeof(header));
+
+    last_frame.fill(false);
+    start_time = std::chrono::steady_clock::now();
+    recording = true;
+    writer_thread = std::thread(&FrameRecorder::run_writer, this);
+    return true;
+}
+
+bool FrameRecorder::stop() {
+    if (!recording) {
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    frames_ready.notify_one();
+    writer_thread.join();
+    recording = false;
+
+    // The writer thread has closed the stream, which also flushed whatever was left in the buffer.
+    return !file_stream.fail();
+}
+
+void FrameRecorder::capture(const Frame& frame) {
+    if (!recording || frame == last_frame) {
+        return;
+    }
+    last_frame = frame;
+
+    auto elapsed = std::chrono::steady_clock::now() - start_time;
+    uint32_t timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back({timestamp_ms, frame});
+    }
+    frames_ready.notify_one();
+}
+
+void FrameRecorder::run_writer() {
+    std::vector<PendingFrame> batch;
+    Frame previous {};
+    uint32_t previous_timestamp = 0;
+
+    auto write_record = [&](uint32_t timestamp_ms, const Frame& frame) {
+        write_varint(file_stream, timestamp_ms - previous_timestamp);
+        previous_timestamp = timestamp_ms;
+
+        // Alternating runs of unchanged and changed pixels, starting with unchanged.
+        bool changed = false;
+        uint32_t run = 0;
+        for (size_t i=0; i<frame.size(); i++) {
+            if ((frame[i] != previous[i]) != changed) {
+                write_varint(file_stream, run);
+                changed = !changed;
+                run = 0;
+            }
+            run++;
+        }
+        write_varint(file_stream, run);
+        previous = frame;
+    };
+
+    while (true) {
+        bool done;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frames_ready.wait(lock, [this] { return !queue.empty() || stopping; });
+            // Take the whole queue so the emulation thread is never blocked behind file I/O.
+            batch.swap(queue);
+            done = stopping;
+        }
+
+        for (const PendingFrame& pending : batch) {
+            write_record(pending.timestamp_ms, pending.frame);
+        }
+        batch.clear();
+
+        if (done) {
+            break;
+        }
+    }
+
+    // End marker: a record that changes nothing.
+    auto elapsed = std::chrono::steady_clock::now() - start_time;
+    write_record(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(), previous);
+    file_stream.close();
+}
+
+//  ---------- Playback ----------
+FrameReader::FrameReader(std::string path) {
+    file_stream.open(path, std::ios::in | std::ios::binary);
+    if (!file_stream.is_open()) {
+        throw 2;
+    }
+
+    char header[7] = {};
+    file_stream.read(header, sizeof(header));
+    if (!file_stream || std::memcmp(header, CAPTURE_MAGIC, 4) != 0 || header[4] != CAPTURE_VERSION
+            || header[5] != SCREEN_WIDTH || header[6] != SCREEN_HEIGHT) {
+        throw 3;
+    }
+}
+
+bool FrameReader::read_varint(uint32_t& value) {
+    value = 0;
+    for (int shift=0; shift<35; shift+=7) {
+        int byte = file_stream.get();
+        if (byte == EOF) {
+            return false;
+        }
+        value |= (uint32_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FrameReader::next(Frame& out, uint32_t& out_timestamp_ms) {
+    uint32_t delta;
+    if (!read_varint(delta)) {
+        return false; // Truncated recording, treat the last frame as the end.
+    }
+    timestamp_ms += delta;
+
+    bool changed = false;
+    bool any_changed = false;
+    size_t position = 0;
+    while (position < frame.size()) {
+        uint32_t run;
+        if (!read_varint(run) || run > frame.size() - position) {
+            return false;
+        }
+        if (changed) {
+            for (size_t i=position; i<position + run; i++) {
+                frame[i] = !frame[i];
+            }
+            any_changed = any_changed || run > 0;
+        }
+        position += run;
+        changed = !changed;
+    }
+
+    if (!any_changed) {
+        return false;
+    }
+
+    out = frame;
+    out_timestamp_ms = timestamp_ms;
+    return true;
+}
@@ -2,6 +2,7 @@
 #include <random>
 #include <fstream>
 #include <thread>
+#include <algorithm>
 #include <stdio.h>
 
 #include "chip8.h"
@@ -10,6 +11,24 @@
 
 Chip8::Chip8(): keyboard() {};
 
+const char* describe_fault(Chip8Fault fault) {
+    switch (fault) {
+        case Chip8Fault::None:
+            return "no fault";
+        case Chip8Fault::StackOverflow:
+            return "stack overflow";
+        case Chip8Fault::StackUnderflow:
+            return "return with an empty stack";
+        case Chip8Fault::PcOutOfBounds:
+            return "program counter out of bounds";
+        case Chip8Fault::MemoryOutOfBounds:
+            return "memory access out of bounds";
+        case Chip8Fault::UnknownOpcode:
+            return "unknown opcode";
+    }
+    return "unknown fault";
+}
+
 void Chip8::load_font() {
     for (int i=0; i<CHIP8_FONT_SIZE; i++) {
         memory[i] = chip8_fontset[i];
@@ -30,9 +49,18 @@ void Chip8::load_rom(std::string rom_name) {
     }
 }
 
-uint16_t Chip8::get_next_op_code() {
-    uint8_t first_byte = memory[pc];
-    uint8_t second_byte = memory[pc + 1];
+void Chip8::load_rom_data(const uint8_t* data, size_t size) {
+    size_t length = std::min(size, memory.size() - pc);
+    std::copy(data, data + length, memory.begin() + pc);
+}
+
+void Chip8::set_hardened(bool enabled) {
+    hardened = enabled;
+}
+
+uint16_t Chip8::get_next_op_code() const {
+    uint8_t first_byte = memory[pc & ADDRESS_MASK];
+    uint8_t second_byte = memory[(pc + 1) & ADDRESS_MASK];
     return (first_byte << 8) | second_byte;
 }
 
@@ -102,8 +130,7 @@ void Chip8::perform_cycle() {
     auto start = std::chrono::steady_clock::now();
     int sleep_duration = (int) (1.0 / CPU_SPEED  * 1000);
 
-    uint16_t next_op_code = get_next_op_code();
-    handle_op_code(next_op_code);
+    execute_instruction();
 
     SDL_Delay(sleep_duration);
     auto elapsed = std::chrono::steady_clock::now() - start;
@@ -112,6 +139,20 @@ void Chip8::perform_cycle() {
     update_timer(elapsed_ms.count() * SOUND_SPEED);
 }
 
+void Chip8::execute_instruction() {
+    // A single fetch/decode/execute step with no pacing or timer updates.
+    if (is_halted() || !check_fault(pc < ADDRESS_MASK, Chip8Fault::PcOutOfBounds)) {
+        return;
+    }
+
+    uint16_t next_op_code = get_next_op_code();
+    handle_op_code(next_op_code);
+}
+
+void Chip8::seed_random(uint32_t seed) {
+    rng.seed(seed);
+}
+
 void Chip8::print_memory() {
     std::cout << "Memory dump: " << std::endl;
     for (int i=0; i < memory.size(); i++) {
@@ -123,6 +164,18 @@ inline void Chip8::increment_pc() {
     pc += 2;
 }
 
+inline bool Chip8::check_fault(bool valid, Chip8Fault kind) {
+    // Returns whether the instruction should go ahead. Only the first fault is recorded.
+    if (valid) {
+        return true;
+    }
+    if (fault == Chip8Fault::None) {
+        fault = kind;
+        fault_pc = pc;
+    }
+    return !hardened;
+}
+
 void Chip8::update_timer(double delta) {
     delay_timer_high_res -= delta  / 1000;
     delay_timer_high_res = delay_timer_high_res < 0 ? 0 : delay_timer_high_res;
@@ -152,8 +205,14 @@ void Chip8::handle_op_code_0(uint16_t opcode) {
         }
     } else if (opcode == 0x00EE) {
         // Return from a subroutine by popping the stack
-        pc = stack.top();
-        stack.pop();
+        if (!check_fault(sp > 0, Chip8Fault::StackUnderflow)) {
+            return;
+        }
+        // Without hardened mode a return on an empty stack just falls through to the next instruction.
+        if (sp > 0) {
+            sp--;
+            pc = stack[sp];
+        }
     }
     // If this is a return instruction we still need to increment the PC.
     // We pushed the PC onto the stack without incrementing it, which means the instruction on
@@ -171,7 +230,14 @@ void Chip8::handle_op_code_1(uint16_t opcode) {
 void Chip8::handle_op_code_2(uint16_t opcode) {
     // Opcode 2NNN, Call subroutine at address NNN
     uint16_t address = opcode & 0x0FFF;
-    stack.push(pc);
+    if (!check_fault(sp < STACK_SIZE, Chip8Fault::StackOverflow)) {
+        return;
+    }
+    // Without hardened mode a call on a full stack still jumps, but the return address is lost.
+    if (sp < STACK_SIZE) {
+        stack[sp] = pc;
+        sp++;
+    }
     pc = address;
 }
 
@@ -260,7 +326,7 @@ void Chip8::handle_op_code_8(uint16_t opcode) {
         }
         case 0x5: {
             // 8XY5, VY is subtracted from VX. VF is set to 0 when there's a borrow, and 1 when there isn't
-            V[CARRY_FLAG] = V[x] > V[y] ? 1 : 0;
+            V[CARRY_FLAG] = V[x] >= V[y] ? 1 : 0;
             V[x] = V[x] - V[y];
             break;
         }
@@ -272,7 +338,7 @@ void Chip8::handle_op_code_8(uint16_t opcode) {
         }
         case 0x7: {
             // 8XY7, Sets VX to VY minus VX. VF is set to 0 when there's a borrow, and 1 when there isn't.
-            V[CARRY_FLAG] = V[y] > V[x] ? 1 : 0;
+            V[CARRY_FLAG] = V[y] >= V[x] ? 1 : 0;
             V[x] = V[y] - V[x];
             break;
         }
@@ -314,8 +380,6 @@ void Chip8::handle_op_code_B(uint16_t opcode) {
 
 void Chip8::handle_op_code_C(uint16_t opcode) {
     // Opcode CXNN, Sets VX to the result of a bitwise and operation on a random number and NN.
-    std::random_device dev;  // TODO - Construct this only once
-    std::mt19937 rng(dev());
     std::uniform_int_distribution<std::mt19937::result_type> dist(0, 255);
     uint8_t rand = dist(rng);
 
@@ -335,14 +399,18 @@ void Chip8::handle_op_code_D(uint16_t opcode) {
     uint8_t xPos = V[x] % SCREEN_WIDTH;
     uint8_t yPos = V[y] % SCREEN_HEIGHT;
     uint8_t width = 8;
-    uint8_t* pixel_row_ptr = &(memory[I]);
 
     bool pixels_changed = false;
     uint8_t max_row = std::min(yPos + height, SCREEN_HEIGHT);
 
+    if (!check_fault((size_t) (I + (max_row - yPos)) <= memory.size(), Chip8Fault::MemoryOutOfBounds)) {
+        return;
+    }
+    uint16_t sprite_address = I;
+
     for (int row=yPos; row < max_row; row++) {
-        uint8_t pixel_row = *pixel_row_ptr;
-        pixel_row_ptr++;
+        uint8_t pixel_row = memory[sprite_address & ADDRESS_MASK];
+        sprite_address++;
 
         // Extract individual pixel values from this byte.
         std::array<bool, 8> pixel_values {
@@ -374,16 +442,17 @@ void Chip8::handle_op_code_D(uint16_t opcode) {
 
 void Chip8::handle_op_code_E(uint16_t opcode) {
     uint8_t last_byte = opcode & 0x00FF;
-    uint8_t x = (opcode & 0x0F00) > 8;
+    uint8_t x = (opcode & 0x0F00) >> 8;
+    uint8_t key = V[x] & 0xF; // There are only 16 keys
 
     if (last_byte == 0x9E) {
         // EX9E	Skips the next instruction if the key stored in VX is pressed.
-        if (keyboard.is_key_down(V[x])) {
+        if (keyboard.is_key_down(key)) {
             increment_pc();
         }
     } else if (last_byte == 0xA1) {
         // EXA1	Skips the next instruction if the key stored in VX isn't pressed.
-        if (keyboard.is_key_up(V[x])) {
+        if (keyboard.is_key_up(key)) {
             increment_pc();
         }
     }
@@ -436,23 +505,32 @@ void Chip8::handle_op_code_F(uint16_t opcode) {
         case 0x33: {
             // FX33 Stores the binary-coded decimal representation of VX, with the most significant of three digits at the address in I,
             // the middle digit at I plus 1, and the least significant digit at I plus 2.
+            if (!check_fault((size_t) (I + 3) <= memory.size(), Chip8Fault::MemoryOutOfBounds)) {
+                return;
+            }
             uint8_t val = V[x];
-            memory[I] = val / 100; // hundreds
-            memory[I + 1] = (val % 100) / 10; // tens;
-            memory[I + 2] = val % 10; // ones
+            memory[I & ADDRESS_MASK] = val / 100; // hundreds
+            memory[(I + 1) & ADDRESS_MASK] = (val % 100) / 10; // tens;
+            memory[(I + 2) & ADDRESS_MASK] = val % 10; // ones
             break;
         }
         case 0x55: {
             // FX55 Stores V0 to VX (including VX) in memory starting at address I. The offset from I is increased by 1 for each value written, but I itself is left unmodified.
+            if (!check_fault((size_t) (I + x) < memory.size(), Chip8Fault::MemoryOutOfBounds)) {
+                return;
+            }
             for (int i=0; i<=x; i++) {
-                memory[I + i] = V[i];
+                memory[(I + i) & ADDRESS_MASK] = V[i];
             }
             break;
         }
         case 0x65: {
             // FX65 Fills V0 to VX (including VX) with values from memory starting at address I. The offset from I is increased by 1 for each value written, but I itself is left unmodified.
+            if (!check_fault((size_t) (I + x) < memory.size(), Chip8Fault::MemoryOutOfBounds)) {
+                return;
+            }
             for (int i=0; i<=x; i++) {
-                V[i] = memory[I + i];
+                V[i] = memory[(I + i) & ADDRESS_MASK];
             }
             break;
         }
@@ -466,7 +544,14 @@ void Chip8::handle_op_code_F(uint16_t opcode) {
 
 
 void Chip8::handle_op_code_unknown(uint16_t opcode) {
-    std::cerr << "Unknown opcode: " << std::hex << opcode << std::dec << std::endl;
+    // Only report the first one, a ROM that runs off into data would otherwise flood stderr.
+    if (!unknown_opcode_reported) {
+        std::cerr << "Unknown opcode: " << std::hex << opcode << std::dec << std::endl;
+        unknown_opcode_reported = true;
+    }
+    if (!check_fault(false, Chip8Fault::UnknownOpcode)) {
+        return;
+    }
     increment_pc(); // Does it really make sense to continue in the scenario?
 }
 
@@ -0,0 +1,573 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "gdb_server.h"
+
+#define GDB_SIGINT 2
+#define GDB_SIGTRAP 5
+
+#define REG_I 16
+#define REG_PC 17
+#define REG_SP 18
+#define REG_DT 19
+#define REG_ST 20
+#define REG_COUNT 21
+
+static const std::string target_xml =
+    "<?xml version=\"1.0\"?>"
+    "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+    "<target version=\"1.0\">"
+    "<feature name=\"org.chip8.core\">"
+    "<reg name=\"v0\" bitsize=\"8\" type=\"uint8\" regnum=\"0\"/>"
+    "<reg name=\"v1\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"v2\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"v3\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"v4\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"v5\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"v6\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"v7\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"v8\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"v9\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"va\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"vb\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"vc\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"vd\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"ve\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"vf\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"i\" bitsize=\"16\" type=\"data_ptr\"/>"
+    "<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>"
+    "<reg name=\"sp\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"dt\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"st\" bitsize=\"8\" type=\"uint8\"/>"
+    "</feature>"
+    "</target>";
+
+static std::string to_hex(uint32_t value, int bytes) {
+    // Registers are sent in target byte order, which we define as little endian.
+    std::string hex;
+    char buf[3];
+    for (int i=0; i<bytes; i++) {
+        snprintf(buf, sizeof(buf), "%02x", (value >> (8 * i)) & 0xFF);
+        hex += buf;
+    }
+    return hex;
+}
+
+static bool from_hex(const std::string& hex, int bytes, uint32_t& value) {
+    // Returns false if there aren't enough digits, clients can send us anything.
+    if (hex.size() < (size_t) bytes * 2) {
+        return false;
+    }
+
+    value = 0;
+    for (int i=0; i<bytes; i++) {
+        uint32_t byte = std::strtoul(hex.substr(i * 2, 2).c_str(), nullptr, 16);
+        value |= byte << (8 * i);
+    }
+    return true;
+}
+
+static int register_size(unsigned int reg) {
+    return (reg == REG_I || reg == REG_PC) ? 2 : 1;
+}
+
+GdbServer::GdbServer(Chip8& chip): chip(chip) {};
+
+GdbServer::~GdbServer() {
+    stop();
+}
+
+bool GdbServer::start(uint16_t port) {
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "Error creating GDB socket" << std::endl;
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);  // Only ever listen on localhost
+
+    if (bind(listen_fd, (sockaddr*) &addr, sizeof(addr)) < 0 || listen(listen_fd, 1) < 0) {
+        std::cerr << "Error listening for GDB on port " << port << std::endl;
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    std::cout << "Waiting for GDB on localhost:" << port << std::endl;
+    io_thread = std::thread(&GdbServer::run_io_loop, this);
+    return true;
+}
+
+void GdbServer::stop() {
+    if (listen_fd < 0) {
+        return;
+    }
+
+    stopping = true;
+
+    // Shutting the sockets down unblocks accept() and recv() on the I/O thread.
+    shutdown(listen_fd, SHUT_RDWR);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (client_fd >= 0) {
+            shutdown(client_fd, SHUT_RDWR);
+        }
+    }
+    halt_acknowledged.notify_all();
+
+    io_thread.join();
+    close(listen_fd);
+    listen_fd = -1;
+}
+
+bool GdbServer::service_attached() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!attached) {
+        return true;
+    }
+
+    if (halt_requested) {
+        // A debugger just connected. Stopping here, between instructions, is what makes the CPU state safe to touch.
+        halt_requested = false;
+        interrupt_requested = false;
+        halted = true;
+        halt_acknowledged.notify_all();
+    }
+
+    if (!halted) {
+        int signal = 0;
+        if (interrupt_requested) {
+            interrupt_requested = false;
+            signal = GDB_SIGINT;
+        } else if (stepping && step_taken) {
+            signal = GDB_SIGTRAP;
+        } else if (breakpoints[chip.pc & 0xFFF] && !skip_breakpoint) {
+            signal = GDB_SIGTRAP;
+        }
+
+        // When resuming from a breakpoint we must execute the instruction under it before checking again.
+        skip_breakpoint = false;
+        step_taken = stepping;
+
+        if (signal == 0) {
+            return true;
+        }
+
+        halted = true;
+        stepping = false;
+        send_stop_reply(signal);
+    }
+
+    // Don't spin while halted, but wake up often enough for the caller to keep pumping SDL events.
+    resumed.wait_for(lock, std::chrono::milliseconds(10), [this] { return !halted || !attached; });
+    return false;
+}
+
+//  ---------- I/O thread ----------
+void GdbServer::run_io_loop() {
+    while (!stopping) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+
+        int no_delay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+        attach(fd);
+        serve_client();
+        detach();
+    }
+}
+
+void GdbServer::attach(int fd) {
+    std::lock_guard<std::mutex> lock(mutex);
+    client_fd = fd;
+
+    // GDB expects the target to be stopped as soon as it connects. It will ask why with a '?' packet.
+    // The emulation thread may be mid-instruction, so only ask it to stop; serve_client() waits for it.
+    halted = false;
+    halt_requested = true;
+    interrupt_requested = false;
+    stepping = false;
+    step_taken = false;
+    skip_breakpoint = false;
+    breakpoints.fill(false);
+
+    attached.store(true, std::memory_order_release);
+    std::cout << "GDB attached" << std::endl;
+}
+
+void GdbServer::detach() {
+    std::lock_guard<std::mutex> lock(mutex);
+    attached.store(false, std::memory_order_release);
+    halted = false;
+    halt_requested = false;
+    close(client_fd);
+    client_fd = -1;
+    resumed.notify_all();
+    std::cout << "GDB detached" << std::endl;
+}
+
+void GdbServer::serve_client() {
+    std::string buffer;
+    char chunk[1024];
+
+    while (true) {
+        ssize_t received = recv(client_fd, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            return;
+        }
+        buffer.append(chunk, received);
+
+        while (!buffer.empty()) {
+            if (buffer[0] != '$') {
+                // Acks are ignored, a raw 0x03 byte is an interrupt request.
+                if (buffer[0] == 0x03) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    interrupt_requested = !halted && !halt_requested;
+                }
+                buffer.erase(0, 1);
+                continue;
+            }
+
+            // Packets are of the form $payload#xx, wait until we have the whole thing.
+            size_t end = buffer.find('#');
+            if (end == std::string::npos || buffer.size() < end + 3) {
+                break;
+            }
+
+            std::string payload = buffer.substr(1, end - 1);
+            uint8_t expected = std::strtoul(buffer.substr(end + 1, 2).c_str(), nullptr, 16);
+            buffer.erase(0, end + 3);
+
+            uint8_t checksum = 0;
+            for (char c : payload) {
+                checksum += (uint8_t) c;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            if (checksum != expected) {
+                send_raw("-");
+                continue;
+            }
+            send_raw("+");
+
+            if (payload == "D" || payload == "k") {
+                // Detaching (or killing) just lets the emulator carry on without a debugger.
+                if (payload == "D") {
+                    send_packet("OK");
+                }
+                return;
+            }
+
+            halt_acknowledged.wait(lock, [this] { return !halt_requested || stopping; });
+            if (stopping) {
+                return;
+            }
+            handle_packet(payload);
+        }
+    }
+}
+
+//  ---------- Packet handlers (mutex held) ----------
+void GdbServer::handle_packet(const std::string& packet) {
+    if (packet.empty()) {
+        send_packet("");
+        return;
+    }
+
+    char command = packet[0];
+    std::string args = packet.substr(1);
+
+    switch (command) {
+        case '?': {
+            send_stop_reply(GDB_SIGTRAP);
+            return;
+        }
+        case 'q': {
+            send_packet(handle_query(packet));
+            return;
+        }
+        case 'H': {
+            // There's only one thread.
+            send_packet("OK");
+            return;
+        }
+        case 'Z':
+        case 'z': {
+            send_packet(set_breakpoint(args, command == 'Z'));
+            return;
+        }
+    }
+
+    // Everything past this point touches CPU state, which is only safe while the CPU is halted.
+    if (!halted) {
+        send_packet("E01");
+        return;
+    }
+
+    switch (command) {
+        case 'g': {
+            send_packet(read_registers());
+            break;
+        }
+        case 'G': {
+            // Parse everything before writing anything, so a malformed packet leaves the registers alone.
+            std::array<uint32_t, REG_COUNT> values;
+            size_t offset = 0;
+            unsigned int count = 0;
+            bool valid = true;
+            for (; count<REG_COUNT && offset < args.size() && valid; count++) {
+                int size = register_size(count);
+                valid = from_hex(args.substr(offset, size * 2), size, values[count]);
+                offset += size * 2;
+            }
+            if (valid) {
+                for (unsigned int reg=0; reg<count; reg++) {
+                    write_register(reg, values[reg]);
+                }
+            }
+            send_packet(valid ? "OK" : "E01");
+            break;
+        }
+        case 'p': {
+            unsigned long reg = std::strtoul(args.c_str(), nullptr, 16);
+            send_packet(reg < REG_COUNT ? read_register(reg) : "E01");
+            break;
+        }
+        case 'P': {
+            size_t equals = args.find('=');
+            unsigned long reg = std::strtoul(args.substr(0, equals).c_str(), nullptr, 16);
+            uint32_t value;
+            bool valid = equals != std::string::npos && reg < REG_COUNT
+                && from_hex(args.substr(equals + 1), register_size(reg), value)
+                && write_register(reg, value);
+            send_packet(valid ? "OK" : "E01");
+            break;
+        }
+        case 'm': {
+            send_packet(read_memory(args));
+            break;
+        }
+        case 'M': {
+            send_packet(write_memory(args));
+            break;
+        }
+        case 'c': {
+            resume(args, false);
+            break;
+        }
+        case 's': {
+            resume(args, true);
+            break;
+        }
+        default: {
+            // An empty response means the packet isn't supported.
+            send_packet("");
+            break;
+        }
+    }
+}
+
+std::string GdbServer::handle_query(const std::string& packet) {
+    if (packet.rfind("qSupported", 0) == 0) {
+        return "PacketSize=1000;qXfer:features:read+";
+    }
+    if (packet == "qAttached") {
+        return "1";
+    }
+    if (packet == "qfThreadInfo") {
+        return "m1";
+    }
+    if (packet == "qsThreadInfo") {
+        return "l";
+    }
+
+    std::string prefix = "qXfer:features:read:target.xml:";
+    if (packet.rfind(prefix, 0) == 0) {
+        // qXfer:features:read:target.xml:offset,length
+        std::string range = packet.substr(prefix.size());
+        size_t comma = range.find(',');
+        if (comma == std::string::npos) {
+            return "E01";
+        }
+        size_t offset = std::strtoul(range.substr(0, comma).c_str(), nullptr, 16);
+        size_t length = std::strtoul(range.substr(comma + 1).c_str(), nullptr, 16);
+
+        if (offset >= target_xml.size()) {
+            return "l";
+        }
+        std::string chunk = target_xml.substr(offset, length);
+        return (offset + chunk.size() < target_xml.size() ? "m" : "l") + chunk;
+    }
+
+    return "";
+}
+
+std::string GdbServer::read_registers() {
+    std::string hex;
+    for (int reg=0; reg<REG_COUNT; reg++) {
+        hex += read_register(reg);
+    }
+    return hex;
+}
+
+std::string GdbServer::read_register(unsigned int reg) {
+    if (reg < 16) {
+        return to_hex(chip.V[reg], 1);
+    }
+
+    switch (reg) {
+        case REG_I:
+            return to_hex(chip.I, 2);
+        case REG_PC:
+            return to_hex(chip.pc, 2);
+        case REG_SP:
+            return to_hex(chip.sp, 1);
+        case REG_DT:
+            return to_hex(chip.delay_timer, 1);
+        case REG_ST:
+            return to_hex(chip.sound_timer, 1);
+        default:
+            return "E01";
+    }
+}
+
+bool GdbServer::write_register(unsigned int reg, uint16_t value) {
+    if (reg < 16) {
+        chip.V[reg] = value;
+        return true;
+    }
+
+    switch (reg) {
+        case REG_I:
+            chip.I = value & 0xFFF;
+            return true;
+        case REG_PC:
+            chip.pc = value & 0xFFF;
+            return true;
+        case REG_DT:
+            chip.set_delay_timer(value);
+            return true;
+        case REG_ST:
+            chip.set_sound_timer(value);
+            return true;
+        case REG_SP:
+            if (value > STACK_SIZE) {
+                return false;
+            }
+            chip.sp = value;
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::string GdbServer::read_memory(const std::string& args) {
+    // m addr,length
+    size_t comma = args.find(',');
+    size_t addr = std::strtoul(args.substr(0, comma).c_str(), nullptr, 16);
+    size_t length = std::strtoul(args.substr(comma + 1).c_str(), nullptr, 16);
+
+    if (comma == std::string::npos || addr >= chip.memory.size()) {
+        return "E01";
+    }
+    length = std::min(length, chip.memory.size() - addr);
+
+    std::string hex;
+    for (size_t i=0; i<length; i++) {
+        hex += to_hex(chip.memory[addr + i], 1);
+    }
+    return hex;
+}
+
+std::string GdbServer::write_memory(const std::string& args) {
+    // M addr,length:XX...
+    size_t comma = args.find(',');
+    size_t colon = args.find(':');
+    if (comma == std::string::npos || colon == std::string::npos) {
+        return "E01";
+    }
+
+    size_t addr = std::strtoul(args.substr(0, comma).c_str(), nullptr, 16);
+    size_t length = std::strtoul(args.substr(comma + 1, colon - comma - 1).c_str(), nullptr, 16);
+    std::string data = args.substr(colon + 1);
+
+    if (addr >= chip.memory.size() || length > chip.memory.size() - addr || data.size() / 2 < length) {
+        return "E01";
+    }
+
+    for (size_t i=0; i<length; i++) {
+        uint32_t value;
+        from_hex(data.substr(i * 2, 2), 1, value);
+        chip.memory[addr + i] = value;
+    }
+    return "OK";
+}
+
+std::string GdbServer::set_breakpoint(const std::string& args, bool enabled) {
+    // Z0,addr,kind for software breakpoints, Z1 for hardware breakpoints. We treat both the same.
+    if (args.empty() || (args[0] != '0' && args[0] != '1')) {
+        return "";
+    }
+
+    size_t addr_start = args.find(',');
+    if (addr_start == std::string::npos) {
+        return "E01";
+    }
+
+    size_t addr = std::strtoul(args.substr(addr_start + 1).c_str(), nullptr, 16);
+    if (addr >= breakpoints.size()) {
+        return "E01";
+    }
+
+    breakpoints[addr] = enabled;
+    return "OK";
+}
+
+void GdbServer::resume(const std::string& args, bool step) {
+    // c [addr] / s [addr]. The stop reply is sent from the emulation thread once the CPU halts again.
+    if (!args.empty()) {
+        chip.pc = std::strtoul(args.c_str(), nullptr, 16) & 0xFFF;
+    }
+
+    halted = false;
+    stepping = step;
+    step_taken = false;
+    skip_breakpoint = true;
+    resumed.notify_all();
+}
+
+void GdbServer::send_stop_reply(int signal) {
+    send_packet("S" + to_hex(signal, 1));
+}
+
+void GdbServer::send_packet(const std::string& payload) {
+    uint8_t checksum = 0;
+    for (char c : payload) {
+        checksum += (uint8_t) c;
+    }
+    send_raw("$" + payload + "#" + to_hex(checksum, 1));
+}
+
+void GdbServer::send_raw(const std::string& data) {
+    if (client_fd >= 0) {
+        send(client_fd, data.data(), data.size(), MSG_NOSIGNAL);
+    }
+}
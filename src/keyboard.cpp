@@ -2,12 +2,11 @@
 
 bool Keyboard::is_key_down(uint8_t key) {
     const Uint8* currentKeyStates = SDL_GetKeyboardState(NULL);
-    return currentKeyStates[key_map[key]];
+    return virtual_keys[key] || currentKeyStates[key_map[key]];
 }
 
 bool Keyboard::is_key_up(uint8_t key) {
-    const Uint8* currentKeyStates = SDL_GetKeyboardState(NULL);
-    return !currentKeyStates[key_map[key]];
+    return !is_key_down(key);
 }
 
 std::array<bool, 16> Keyboard::get_key_state() {
@@ -38,4 +37,8 @@ uint8_t Keyboard::await_key_press() {
 
 void Keyboard::remap_key(uint8_t chip_key, SDL_Scancode key) {
     key_map[chip_key] = key;
+}
+
+void Keyboard::set_virtual_key(uint8_t key, bool down) {
+    virtual_keys[key & 0xF] = down;
 }
\ No newline at end of file
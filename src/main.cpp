@@ -1,5 +1,8 @@
 #include <iostream>
+#include <cstdlib>
 #include "chip8.h"
+#include "gdb_server.h"
+#include "capture.h"
 
 #include <SDL2/SDL.h>
 
@@ -35,9 +38,33 @@ int main(int argc, char** argv) {
     }
 
     std::string rom_name = argv[1];
+    uint16_t gdb_port = 0;
+    bool hardened = false;
+    std::string record_path;
+
+    for (int i=2; i<argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--gdb" && i + 1 < argc) {
+            char* end;
+            unsigned long port = std::strtoul(argv[++i], &end, 10);
+            if (*argv[i] == '\0' || *end != '\0' || port == 0 || port > 65535) {
+                std::cerr << "Invalid GDB port: " << argv[i] << std::endl;
+                return 1;
+            }
+            gdb_port = port;
+        } else if (arg == "--record" && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (arg == "--hardened") {
+            hardened = true;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
 
     Chip8 chip;
     chip.load_font();
+    chip.set_hardened(hardened);
 
     try {
         chip.load_rom(rom_name);
@@ -46,6 +73,16 @@ int main(int argc, char** argv) {
         return err;
     }
 
+    GdbServer gdb_server(chip);
+    if (gdb_port != 0 && !gdb_server.start(gdb_port)) {
+        return 1;
+    }
+
+    FrameRecorder recorder;
+    if (!record_path.empty() && !recorder.start(record_path)) {
+        return 1;
+    }
+
     SDL_Window* window = NULL;
     SDL_Renderer* renderer = NULL;
 
@@ -66,12 +103,27 @@ int main(int argc, char** argv) {
                 user_quit = true;
             }
         }
-        chip.perform_cycle();
+        if (gdb_server.service()) {
+            chip.perform_cycle();
+        }
+        if (chip.is_halted()) {
+            std::cerr << "CPU fault: " << describe_fault(chip.get_fault())
+                      << " at " << std::hex << chip.get_fault_pc() << std::dec << std::endl;
+            break;
+        }
         if (chip.draw_flag) {
             chip.draw_screen(renderer);
+            recorder.capture(chip.get_gfx());
         }
     }
 
     SDL_DestroyWindow(window);
     SDL_Quit();
+
+    if (!recorder.stop()) {
+        std::cerr << "Error writing recording to " << record_path << std::endl;
+        return 1;
+    }
+
+    return chip.is_halted() ? 1 : 0;
 }
\ No newline at end of file
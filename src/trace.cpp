@@ -0,0 +1,181 @@
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+#include "trace.h"
+
+// Nominal timer decrement per instruction, in the units update_timer() expects.
+#define TRACE_TIMER_DELTA (1000.0 / CPU_SPEED * SOUND_SPEED)
+
+bool TraceRecord::operator==(const TraceRecord& other) const {
+    return step == other.step
+        && pc == other.pc
+        && opcode == other.opcode
+        && I == other.I
+        && sp == other.sp
+        && delay_timer == other.delay_timer
+        && V == other.V
+        && gfx_hash == other.gfx_hash;
+}
+
+std::string format_trace_record(const TraceRecord& record) {
+    std::ostringstream out;
+    out << std::hex << std::uppercase << std::setfill('0');
+    out << std::dec << record.step << std::hex
+        << " pc=" << std::setw(3) << record.pc
+        << " op=" << std::setw(4) << record.opcode
+        << " I=" << std::setw(3) << record.I
+        << " sp=" << (int) record.sp
+        << " dt=" << std::setw(2) << (int) record.delay_timer
+        << " V=";
+    for (uint8_t v : record.V) {
+        out << std::setw(2) << (int) v;
+    }
+    out << " gfx=" << std::setw(16) << record.gfx_hash;
+    return out.str();
+}
+
+uint64_t hash_gfx(const std::array<bool, SCREEN_HEIGHT * SCREEN_WIDTH>& gfx) {
+    // 64 bit FNV-1a
+    uint64_t hash = 0xCBF29CE484222325;
+    for (bool pixel : gfx) {
+        hash ^= pixel;
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+static void encode_record(const TraceRecord& record, uint8_t* out) {
+    auto put = [&out](uint64_t value, int bytes) {
+        for (int i=0; i<bytes; i++) {
+            *out++ = (value >> (8 * i)) & 0xFF;
+        }
+    };
+
+    put(record.step, 4);
+    put(record.pc, 2);
+    put(record.opcode, 2);
+    put(record.I, 2);
+    put(record.sp, 1);
+    put(record.delay_timer, 1);
+    for (uint8_t v : record.V) {
+        put(v, 1);
+    }
+    put(record.gfx_hash, 8);
+}
+
+static void decode_record(const uint8_t* in, TraceRecord& record) {
+    auto get = [&in](int bytes) {
+        uint64_t value = 0;
+        for (int i=0; i<bytes; i++) {
+            value |= (uint64_t) *in++ << (8 * i);
+        }
+        return value;
+    };
+
+    record.step = get(4);
+    record.pc = get(2);
+    record.opcode = get(2);
+    record.I = get(2);
+    record.sp = get(1);
+    record.delay_timer = get(1);
+    for (uint8_t& v : record.V) {
+        v = get(1);
+    }
+    record.gfx_hash = get(8);
+}
+
+//  ---------- Trace files ----------
+bool is_trace_file(std::string path) {
+    std::ifstream file_stream(path, std::ios::in | std::ios::binary);
+    char magic[4] = {};
+    file_stream.read(magic, sizeof(magic));
+    return file_stream && std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0;
+}
+
+TraceReader::TraceReader(std::string path): path(path) {
+    file_stream.open(path, std::ios::in | std::ios::binary);
+    if (!file_stream.is_open()) {
+        throw 2;
+    }
+
+    // Header: magic, version (1 byte), record size (1 byte)
+    char header[6] = {};
+    file_stream.read(header, sizeof(header));
+    if (!file_stream || std::memcmp(header, TRACE_MAGIC, 4) != 0
+            || header[4] != TRACE_VERSION || header[5] != TRACE_RECORD_SIZE) {
+        throw 3;
+    }
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    uint8_t raw[TRACE_RECORD_SIZE];
+    file_stream.read((char *) raw, sizeof(raw));
+    if (file_stream.gcount() != sizeof(raw)) {
+        return false;
+    }
+    decode_record(raw, record);
+    return true;
+}
+
+TraceWriter::TraceWriter(std::string path) {
+    // A big buffer keeps multi-million record traces from being syscall bound.
+    file_stream.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file_stream.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file_stream.is_open()) {
+        throw 2;
+    }
+
+    char header[6] = {'C', '8', 'T', 'R', TRACE_VERSION, TRACE_RECORD_SIZE};
+    file_stream.write(header, sizeof(header));
+}
+
+void TraceWriter::write(const TraceRecord& record) {
+    uint8_t raw[TRACE_RECORD_SIZE];
+    encode_record(record, raw);
+    file_stream.write((char *) raw, sizeof(raw));
+}
+
+bool TraceWriter::close() {
+    file_stream.close();
+    return !file_stream.fail();
+}
+
+//  ---------- Reference interpreter ----------
+CoreTraceSource::CoreTraceSource(std::string rom_name, uint32_t max_steps, uint32_t seed):
+    rom_name(rom_name), max_steps(max_steps) {
+    chip.load_font();
+    chip.load_rom(rom_name);
+    chip.seed_random(seed);
+    gfx_hash = hash_gfx(chip.get_gfx());
+}
+
+bool CoreTraceSource::next(TraceRecord& record) {
+    if (step >= max_steps) {
+        return false;
+    }
+
+    uint16_t pc = chip.get_pc();
+    uint16_t opcode = chip.get_next_op_code();
+    if ((opcode & 0xF0FF) == 0xF00A) {
+        return false;
+    }
+
+    chip.execute_instruction();
+    chip.update_timer(TRACE_TIMER_DELTA);
+
+    // Only clearing the screen and drawing touch the framebuffer, so don't rehash it on every step.
+    if (opcode == 0x00E0 || (opcode & 0xF000) == 0xD000) {
+        gfx_hash = hash_gfx(chip.get_gfx());
+    }
+
+    record.step = step++;
+    record.pc = pc;
+    record.opcode = opcode;
+    record.I = chip.get_I();
+    record.sp = chip.get_sp();
+    record.delay_timer = chip.get_delay_timer();
+    record.V = chip.get_registers();
+    record.gfx_hash = gfx_hash;
+    return true;
+}
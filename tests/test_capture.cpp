@@ -0,0 +1,100 @@
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "capture.h"
+
+// Capture round trip tests. Frames are recorded with FrameRecorder and must come back unchanged from FrameReader.
+
+int failures = 0;
+
+#define CHECK_EQUAL(actual, expected) check_equal((actual), (expected), #actual, __LINE__)
+
+void check_equal(int actual, int expected, const char* expression, int line) {
+    if (actual != expected) {
+        std::cerr << "line " << line << ": " << expression << " is " << actual
+                  << ", expected " << expected << std::endl;
+        failures++;
+    }
+}
+
+void test_round_trip(std::string path) {
+    std::vector<Frame> frames(4);
+    frames[0][0] = true; // The very first pixel changes, so the record starts with an empty unchanged run
+    frames[1] = frames[0];
+    frames[1][frames[1].size() - 1] = true; // A run that ends exactly at the last pixel
+    frames[2].fill(true);
+    frames[3][100] = true;
+
+    FrameRecorder recorder;
+    CHECK_EQUAL(recorder.start(path), true);
+    for (const Frame& frame : frames) {
+        recorder.capture(frame);
+        recorder.capture(frame); // Unchanged frames aren't recorded
+    }
+    CHECK_EQUAL(recorder.stop(), true);
+
+    FrameReader reader(path);
+    Frame frame;
+    uint32_t timestamp_ms;
+    uint32_t previous_timestamp = 0;
+    for (size_t i=0; i<frames.size(); i++) {
+        if (!reader.next(frame, timestamp_ms)) {
+            std::cerr << "Recording ended after " << i << " of " << frames.size() << " frames" << std::endl;
+            failures++;
+            return;
+        }
+        CHECK_EQUAL(frame == frames[i], true);
+        CHECK_EQUAL(timestamp_ms >= previous_timestamp, true);
+        previous_timestamp = timestamp_ms;
+    }
+
+    CHECK_EQUAL(reader.next(frame, timestamp_ms), false);
+    CHECK_EQUAL(reader.get_end_time() >= previous_timestamp, true);
+
+    // The reader can't tell a truncated file from a finished one, so check the end marker is actually there:
+    // a single unchanged run over the whole screen, which is the varint 2048 as the last two bytes.
+    std::ifstream file_stream(path, std::ios::in | std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file_stream)), std::istreambuf_iterator<char>());
+    CHECK_EQUAL(data.size() > 2, true);
+    if (data.size() > 2) {
+        CHECK_EQUAL(data[data.size() - 2], 0x80);
+        CHECK_EQUAL(data[data.size() - 1], 0x10);
+    }
+}
+
+void test_write_error() {
+    // Writes to /dev/full always fail with ENOSPC, so stop() has to report it.
+    if (!std::ifstream("/dev/full").is_open()) {
+        return;
+    }
+    FrameRecorder recorder;
+    CHECK_EQUAL(recorder.start("/dev/full"), true);
+    Frame frame {};
+    frame[0] = true;
+    recorder.capture(frame);
+    CHECK_EQUAL(recorder.stop(), false);
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "Usage: chip8-capture-test <scratch file>" << std::endl;
+        return 2;
+    }
+
+    try {
+        test_round_trip(argv[1]);
+    } catch(int err) {
+        std::cerr << "Could not read back " << argv[1] << std::endl;
+        failures++;
+    }
+    test_write_error();
+
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All capture tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <iostream>
+#include <vector>
+
+#include "chip8.h"
+
+// Opcode regression tests. Each case loads a handful of instructions at 0x200 and checks the resulting state.
+
+int failures = 0;
+
+#define CHECK_EQUAL(actual, expected) check_equal((actual), (expected), #actual, __LINE__)
+
+void check_equal(int actual, int expected, const char* expression, int line) {
+    if (actual != expected) {
+        std::cerr << "line " << line << ": " << expression << " is " << std::hex << actual
+                  << ", expected " << expected << std::dec << std::endl;
+        failures++;
+    }
+}
+
+void run(Chip8& chip, std::vector<uint8_t> rom, int steps) {
+    chip.load_font();
+    chip.load_rom_data(rom.data(), rom.size());
+    for (int i=0; i<steps; i++) {
+        chip.execute_instruction();
+    }
+}
+
+void test_key_skip_reads_vx() {
+    // V3 holds key 7, which is down. V1 holds key 2, which is up.
+    // Decoding X with > instead of >> would read V1 for any X other than 0.
+    Chip8 pressed;
+    pressed.keyboard.set_virtual_key(7, true);
+    run(pressed, {0x63, 0x07, 0x61, 0x02, 0xE3, 0x9E}, 3); // EX9E skips when VX is down
+    CHECK_EQUAL(pressed.get_pc(), 0x208);
+
+    Chip8 not_released;
+    not_released.keyboard.set_virtual_key(7, true);
+    run(not_released, {0x63, 0x07, 0x61, 0x02, 0xE3, 0xA1}, 3); // EXA1 doesn't skip when VX is down
+    CHECK_EQUAL(not_released.get_pc(), 0x206);
+}
+
+void test_subtract_borrow_flag() {
+    // 8XY5 with VX == VY doesn't borrow, so VF is 1
+    Chip8 equal;
+    run(equal, {0x60, 0x05, 0x61, 0x05, 0x80, 0x15}, 3);
+    CHECK_EQUAL(equal.get_registers()[0x0], 0x00);
+    CHECK_EQUAL(equal.get_registers()[CARRY_FLAG], 1);
+
+    Chip8 borrow;
+    run(borrow, {0x60, 0x04, 0x61, 0x05, 0x80, 0x15}, 3);
+    CHECK_EQUAL(borrow.get_registers()[0x0], 0xFF);
+    CHECK_EQUAL(borrow.get_registers()[CARRY_FLAG], 0);
+
+    // 8XY7 sets VX to VY - VX, same flag rules
+    Chip8 reverse_equal;
+    run(reverse_equal, {0x60, 0x05, 0x61, 0x05, 0x80, 0x17}, 3);
+    CHECK_EQUAL(reverse_equal.get_registers()[0x0], 0x00);
+    CHECK_EQUAL(reverse_equal.get_registers()[CARRY_FLAG], 1);
+
+    Chip8 reverse_borrow;
+    run(reverse_borrow, {0x60, 0x06, 0x61, 0x05, 0x80, 0x17}, 3);
+    CHECK_EQUAL(reverse_borrow.get_registers()[0x0], 0xFF);
+    CHECK_EQUAL(reverse_borrow.get_registers()[CARRY_FLAG], 0);
+}
+
+void check_fault(Chip8& chip, Chip8Fault fault, uint16_t fault_pc) {
+    CHECK_EQUAL(chip.is_halted(), true);
+    CHECK_EQUAL((int) chip.get_fault(), (int) fault);
+    CHECK_EQUAL(chip.get_fault_pc(), fault_pc);
+    // The faulting instruction isn't executed, so the CPU stays parked on it.
+    CHECK_EQUAL(chip.get_pc(), fault_pc);
+}
+
+void test_hardened_faults() {
+    // FX55 with I at the last byte of memory would write V1 past the end
+    Chip8 store;
+    store.set_hardened(true);
+    run(store, {0xAF, 0xFF, 0xF1, 0x55}, 3);
+    check_fault(store, Chip8Fault::MemoryOutOfBounds, 0x202);
+
+    Chip8 underflow;
+    underflow.set_hardened(true);
+    run(underflow, {0x00, 0xEE}, 2);
+    check_fault(underflow, Chip8Fault::StackUnderflow, 0x200);
+    CHECK_EQUAL(underflow.get_sp(), 0);
+
+    // 2200 calls itself forever, the 17th call doesn't fit on the stack
+    Chip8 overflow;
+    overflow.set_hardened(true);
+    run(overflow, {0x22, 0x00}, STACK_SIZE + 2);
+    check_fault(overflow, Chip8Fault::StackOverflow, 0x200);
+    CHECK_EQUAL(overflow.get_sp(), STACK_SIZE);
+
+    // An instruction at 0xFFF would have its second byte past the end of memory
+    Chip8 pc_end;
+    pc_end.set_hardened(true);
+    run(pc_end, {0x1F, 0xFF}, 2);
+    check_fault(pc_end, Chip8Fault::PcOutOfBounds, 0xFFF);
+}
+
+void test_permissive_stack_stays_in_range() {
+    // Without hardened mode execution carries on, but sp never leaves 0..STACK_SIZE
+    Chip8 underflow;
+    run(underflow, {0x00, 0xEE, 0x00, 0xEE}, 2);
+    CHECK_EQUAL(underflow.get_sp(), 0);
+    CHECK_EQUAL(underflow.get_pc(), 0x204);
+    CHECK_EQUAL((int) underflow.get_fault(), (int) Chip8Fault::StackUnderflow);
+
+    Chip8 overflow;
+    run(overflow, {0x22, 0x00}, STACK_SIZE + 4);
+    CHECK_EQUAL(overflow.get_sp(), STACK_SIZE);
+    CHECK_EQUAL(overflow.get_pc(), 0x200);
+    CHECK_EQUAL((int) overflow.get_fault(), (int) Chip8Fault::StackOverflow);
+}
+
+int main() {
+    test_key_skip_reads_vx();
+    test_subtract_borrow_flag();
+    test_hardened_faults();
+    test_permissive_stack_stays_in_range();
+
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All opcode tests passed" << std::endl;
+    return 0;
+}
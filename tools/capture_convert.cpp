@@ -0,0 +1,353 @@
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "capture.h"
+
+#define DEFAULT_SCALE 8
+#define GIF_MIN_DELAY_MS 20 // Viewers slow down anything shorter than 2cs, so such frames are merged into the next
+
+void print_usage() {
+    std::cerr << "Usage:" << std::endl
+              << "  chip8-capture-convert <capture> --png <dir> [--scale N]" << std::endl
+              << "  chip8-capture-convert <capture> --gif <out.gif> [--scale N]" << std::endl;
+}
+
+// Scales a frame up into one byte per pixel (0 or 1).
+std::vector<uint8_t> scale_frame(const Frame& frame, int scale) {
+    int width = SCREEN_WIDTH * scale;
+    std::vector<uint8_t> pixels(width * SCREEN_HEIGHT * scale);
+    for (size_t i=0; i<pixels.size(); i++) {
+        int x = (i % width) / scale;
+        int y = (i / width) / scale;
+        pixels[i] = frame[y * SCREEN_WIDTH + x];
+    }
+    return pixels;
+}
+
+//  ---------- PNG ----------
+// Writes 1 bit greyscale PNGs with stored (uncompressed) deflate blocks, so we don't need zlib.
+uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i=0; i<length; i++) {
+        crc ^= data[i];
+        for (int bit=0; bit<8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+void put_u32_be(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift=24; shift>=0; shift-=8) {
+        out.push_back((value >> shift) & 0xFF);
+    }
+}
+
+void write_png_chunk(std::ofstream& file_stream, const char* type, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> chunk;
+    put_u32_be(chunk, data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    put_u32_be(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    file_stream.write((char *) chunk.data(), chunk.size());
+}
+
+bool write_png(std::string path, const Frame& frame, int scale) {
+    std::ofstream file_stream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file_stream.is_open()) {
+        return false;
+    }
+
+    int width = SCREEN_WIDTH * scale;
+    int height = SCREEN_HEIGHT * scale;
+    std::vector<uint8_t> pixels = scale_frame(frame, scale);
+
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file_stream.write((char *) signature, sizeof(signature));
+
+    std::vector<uint8_t> header;
+    put_u32_be(header, width);
+    put_u32_be(header, height);
+    header.insert(header.end(), {1, 0, 0, 0, 0}); // Bit depth 1, greyscale, deflate, no filter, no interlace
+    write_png_chunk(file_stream, "IHDR", header);
+
+    // Each row is a filter byte followed by the packed pixels.
+    int row_bytes = (width + 7) / 8;
+    std::vector<uint8_t> raw;
+    for (int y=0; y<height; y++) {
+        raw.push_back(0);
+        for (int byte=0; byte<row_bytes; byte++) {
+            uint8_t packed = 0;
+            for (int bit=0; bit<8 && byte * 8 + bit < width; bit++) {
+                packed |= pixels[y * width + byte * 8 + bit] << (7 - bit);
+            }
+            raw.push_back(packed);
+        }
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    for (size_t offset=0; offset<raw.size() || offset == 0; offset+=0xFFFF) {
+        uint16_t length = std::min<size_t>(0xFFFF, raw.size() - offset);
+        bool last = offset + length >= raw.size();
+        zlib.insert(zlib.end(), {(uint8_t) last, (uint8_t) length, (uint8_t) (length >> 8),
+                                 (uint8_t) ~length, (uint8_t) (~length >> 8)});
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+    }
+
+    uint32_t a = 1, b = 0; // Adler-32
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_u32_be(zlib, (b << 16) | a);
+
+    write_png_chunk(file_stream, "IDAT", zlib);
+    write_png_chunk(file_stream, "IEND", {});
+    return true;
+}
+
+//  ---------- GIF ----------
+class GifWriter {
+    public:
+        GifWriter(std::string path, int scale);
+        bool is_open() const { return file_stream.is_open(); }
+        void write_frame(const Frame& frame, uint32_t duration_ms);
+        void close();
+
+    private:
+        std::ofstream file_stream;
+        int scale;
+
+        void write_u16(uint16_t value);
+        std::vector<uint8_t> lzw_encode(const std::vector<uint8_t>& pixels);
+};
+
+GifWriter::GifWriter(std::string path, int scale): scale(scale) {
+    file_stream.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file_stream.is_open()) {
+        return;
+    }
+
+    file_stream.write("GIF89a", 6);
+    write_u16(SCREEN_WIDTH * scale);
+    write_u16(SCREEN_HEIGHT * scale);
+    file_stream.put((char) 0x80); // Global colour table of 2 entries
+    file_stream.put(0); // Background colour
+    file_stream.put(0); // Aspect ratio
+    const char palette[6] = {0, 0, 0, (char) 0xFF, (char) 0xFF, (char) 0xFF};
+    file_stream.write(palette, sizeof(palette));
+
+    // Loop forever
+    const char loop[19] = {0x21, (char) 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0, 0, 0};
+    file_stream.write(loop, sizeof(loop));
+}
+
+void GifWriter::write_u16(uint16_t value) {
+    file_stream.put(value & 0xFF);
+    file_stream.put(value >> 8);
+}
+
+void GifWriter::write_frame(const Frame& frame, uint32_t duration_ms) {
+    // Graphic control extension with the frame delay in centiseconds
+    file_stream.put(0x21);
+    file_stream.put((char) 0xF9);
+    file_stream.put(4);
+    file_stream.put(0);
+    write_u16(std::min<uint32_t>((duration_ms + 5) / 10, 0xFFFF));
+    file_stream.put(0);
+    file_stream.put(0);
+
+    // Image descriptor covering the whole screen
+    file_stream.put(0x2C);
+    write_u16(0);
+    write_u16(0);
+    write_u16(SCREEN_WIDTH * scale);
+    write_u16(SCREEN_HEIGHT * scale);
+    file_stream.put(0);
+
+    std::vector<uint8_t> data = lzw_encode(scale_frame(frame, scale));
+    file_stream.put(2); // Minimum code size, GIF doesn't allow less than 2
+    for (size_t offset=0; offset<data.size(); offset+=255) {
+        size_t length = std::min<size_t>(255, data.size() - offset);
+        file_stream.put(length);
+        file_stream.write((char *) data.data() + offset, length);
+    }
+    file_stream.put(0);
+}
+
+std::vector<uint8_t> GifWriter::lzw_encode(const std::vector<uint8_t>& pixels) {
+    const int min_code_size = 2;
+    const int clear_code = 1 << min_code_size;
+    const int end_code = clear_code + 1;
+
+    // Dictionary as a tree: children[code][pixel] is the code for that string followed by pixel.
+    std::vector<std::array<int16_t, 4>> children(4096);
+    for (auto& node : children) {
+        node.fill(-1);
+    }
+
+    std::vector<uint8_t> out;
+    uint32_t bits = 0;
+    int bit_count = 0;
+    int code_size = min_code_size + 1;
+    int max_code = end_code;
+
+    auto write_code = [&](int code) {
+        bits |= code << bit_count;
+        bit_count += code_size;
+        while (bit_count >= 8) {
+            out.push_back(bits & 0xFF);
+            bits >>= 8;
+            bit_count -= 8;
+        }
+    };
+
+    write_code(clear_code);
+    int current = pixels[0];
+    for (size_t i=1; i<pixels.size(); i++) {
+        int pixel = pixels[i];
+        if (children[current][pixel] >= 0) {
+            current = children[current][pixel];
+            continue;
+        }
+
+        write_code(current);
+        children[current][pixel] = ++max_code;
+        if (max_code >= (1 << code_size)) {
+            code_size++;
+        }
+        if (max_code == 4095) {
+            // Dictionary is full, start again
+            write_code(clear_code);
+            for (auto& node : children) {
+                node.fill(-1);
+            }
+            code_size = min_code_size + 1;
+            max_code = end_code;
+        }
+        current = pixel;
+    }
+
+    write_code(current);
+    write_code(end_code);
+    if (bit_count > 0) {
+        out.push_back(bits & 0xFF);
+    }
+    return out;
+}
+
+void GifWriter::close() {
+    file_stream.put(0x3B);
+    file_stream.close();
+}
+
+//  ---------- Conversion ----------
+int convert_to_png(FrameReader& reader, std::string directory, int scale) {
+    // PNGs carry no timing, so the time each frame was shown for goes alongside them.
+    std::ofstream timings(directory + "/timings.txt");
+    if (!timings.is_open()) {
+        std::cerr << "Could not write to " << directory << std::endl;
+        return 2;
+    }
+
+    Frame frame;
+    uint32_t timestamp_ms;
+    int count = 0;
+    while (reader.next(frame, timestamp_ms)) {
+        char name[32];
+        snprintf(name, sizeof(name), "frame_%06d.png", count++);
+        if (!write_png(directory + "/" + name, frame, scale)) {
+            std::cerr << "Could not write " << name << std::endl;
+            return 2;
+        }
+        timings << name << " " << timestamp_ms << std::endl;
+    }
+    timings << "end " << reader.get_end_time() << std::endl;
+
+    std::cout << "Wrote " << count << " frames" << std::endl;
+    return 0;
+}
+
+int convert_to_gif(FrameReader& reader, std::string path, int scale) {
+    GifWriter writer(path, scale);
+    if (!writer.is_open()) {
+        std::cerr << "Could not write " << path << std::endl;
+        return 2;
+    }
+
+    // A frame can only be written once the next one arrives and its duration is known.
+    Frame pending, frame;
+    uint32_t pending_start = 0, timestamp_ms;
+    bool has_pending = false;
+    int count = 0;
+
+    while (reader.next(frame, timestamp_ms)) {
+        if (has_pending) {
+            if (timestamp_ms - pending_start < GIF_MIN_DELAY_MS) {
+                pending = frame;  // Merge, keeping the earlier start time
+                continue;
+            }
+            writer.write_frame(pending, timestamp_ms - pending_start);
+            count++;
+        }
+        pending = frame;
+        pending_start = timestamp_ms;
+        has_pending = true;
+    }
+
+    if (has_pending) {
+        writer.write_frame(pending, std::max<uint32_t>(reader.get_end_time() - pending_start, GIF_MIN_DELAY_MS));
+        count++;
+    }
+    writer.close();
+
+    std::cout << "Wrote " << count << " frames" << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        print_usage();
+        return 2;
+    }
+
+    std::string input = argv[1];
+    std::string format;
+    std::string output;
+    int scale = DEFAULT_SCALE;
+
+    for (int i=2; i + 1<argc; i+=2) {
+        std::string arg = argv[i];
+        if (arg == "--png" || arg == "--gif") {
+            format = arg;
+            output = argv[i + 1];
+        } else if (arg == "--scale") {
+            scale = std::max(1, std::atoi(argv[i + 1]));
+        } else {
+            print_usage();
+            return 2;
+        }
+    }
+
+    try {
+        FrameReader reader(input);
+        if (format == "--png") {
+            return convert_to_png(reader, output, scale);
+        }
+        if (format == "--gif") {
+            return convert_to_gif(reader, output, scale);
+        }
+    } catch(int err) {
+        std::cerr << (err == 3 ? "Not a valid capture file: " : "Could not open ") << input << std::endl;
+        return 2;
+    }
+
+    print_usage();
+    return 2;
+}
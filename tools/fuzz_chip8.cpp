@@ -0,0 +1,47 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include "chip8.h"
+
+#define FUZZ_MAX_STEPS 20000
+#define FUZZ_TIMER_DELTA (1000.0 / CPU_SPEED * SOUND_SPEED)
+
+// libFuzzer entry point. The first byte picks the mode (hardened or not), the rest is loaded as the ROM.
+// Both modes must be free of crashes and sanitizer reports, hardened mode additionally stops at the first fault.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size < 1) {
+        return 0;
+    }
+
+    Chip8 chip;
+    chip.load_font();
+    chip.load_rom_data(data + 1, size - 1);
+    chip.seed_random(0);
+    chip.set_hardened(data[0] & 1);
+
+    for (int step=0; step<FUZZ_MAX_STEPS && !chip.is_halted(); step++) {
+        // FX0A blocks until a key is pressed, which never happens here.
+        if ((chip.get_next_op_code() & 0xF0FF) == 0xF00A) {
+            break;
+        }
+        chip.execute_instruction();
+        chip.update_timer(FUZZ_TIMER_DELTA);
+    }
+
+    return 0;
+}
+
+#ifdef CHIP8_FUZZ_STANDALONE
+// Replays inputs given on the command line, for reproducing crashes without libFuzzer (e.g. with gcc sanitizers).
+int main(int argc, char** argv) {
+    for (int i=1; i<argc; i++) {
+        std::ifstream file_stream(argv[i], std::ios::in | std::ios::binary);
+        std::vector<uint8_t> input((std::istreambuf_iterator<char>(file_stream)), std::istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        std::cout << argv[i] << ": ok" << std::endl;
+    }
+    return 0;
+}
+#endif
\ No newline at end of file
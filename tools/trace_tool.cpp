@@ -0,0 +1,153 @@
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <cstdlib>
+
+#include "trace.h"
+
+#define DEFAULT_MAX_STEPS 1000000
+#define DIFF_CONTEXT 8 // Number of matching records shown before a divergence
+
+void print_usage() {
+    std::cerr << "Usage:" << std::endl
+              << "  chip8-trace record <rom> <out.trace> [--steps N] [--seed S]" << std::endl
+              << "  chip8-trace diff <a> <b> [--steps N] [--seed S]" << std::endl
+              << "  chip8-trace dump <trace>" << std::endl
+              << std::endl
+              << "diff accepts trace files or ROMs. ROMs are run on the reference interpreter." << std::endl;
+}
+
+std::unique_ptr<TraceSource> open_source(std::string path, uint32_t max_steps, uint32_t seed) {
+    if (is_trace_file(path)) {
+        return std::unique_ptr<TraceSource>(new TraceReader(path));
+    }
+    return std::unique_ptr<TraceSource>(new CoreTraceSource(path, max_steps, seed));
+}
+
+std::string describe_differences(const TraceRecord& a, const TraceRecord& b) {
+    std::string fields;
+    auto check = [&fields](bool differs, std::string name) {
+        if (differs) {
+            fields += fields.empty() ? name : ", " + name;
+        }
+    };
+
+    check(a.pc != b.pc, "pc");
+    check(a.opcode != b.opcode, "opcode");
+    check(a.I != b.I, "I");
+    check(a.sp != b.sp, "sp");
+    check(a.delay_timer != b.delay_timer, "dt");
+    for (int i=0; i<16; i++) {
+        check(a.V[i] != b.V[i], "V" + std::string(1, "0123456789ABCDEF"[i]));
+    }
+    check(a.gfx_hash != b.gfx_hash, "gfx");
+    return fields;
+}
+
+int diff(TraceSource& a, TraceSource& b) {
+    // Only the last few records are kept around, so traces of any length diff in constant memory.
+    std::array<TraceRecord, DIFF_CONTEXT> history;
+    uint64_t steps = 0;
+    TraceRecord record_a, record_b;
+
+    auto print_context = [&]() {
+        uint64_t first = steps > DIFF_CONTEXT ? steps - DIFF_CONTEXT : 0;
+        for (uint64_t i=first; i<steps; i++) {
+            std::cout << "    " << format_trace_record(history[i % DIFF_CONTEXT]) << std::endl;
+        }
+    };
+
+    while (true) {
+        bool has_a = a.next(record_a);
+        bool has_b = b.next(record_b);
+
+        if (!has_a && !has_b) {
+            std::cout << "Traces match (" << steps << " steps)" << std::endl;
+            return 0;
+        }
+
+        if (has_a != has_b) {
+            std::string ended = has_a ? b.name() : a.name();
+            std::cout << ended << " ended after " << steps << " steps" << std::endl;
+            print_context();
+            std::cout << "  " << (has_a ? a.name() : b.name()) << " continues:" << std::endl
+                      << "    " << format_trace_record(has_a ? record_a : record_b) << std::endl;
+            return 1;
+        }
+
+        if (record_a != record_b) {
+            std::cout << "First divergence at step " << steps
+                      << " (" << describe_differences(record_a, record_b) << ")" << std::endl;
+            print_context();
+            std::cout << "  " << a.name() << ":" << std::endl
+                      << "    " << format_trace_record(record_a) << std::endl
+                      << "  " << b.name() << ":" << std::endl
+                      << "    " << format_trace_record(record_b) << std::endl;
+            return 1;
+        }
+
+        history[steps % DIFF_CONTEXT] = record_a;
+        steps++;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        print_usage();
+        return 2;
+    }
+
+    std::string command = argv[1];
+    std::vector<std::string> paths;
+    uint32_t max_steps = DEFAULT_MAX_STEPS;
+    uint32_t seed = 0;
+
+    for (int i=2; i<argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--steps" && i + 1 < argc) {
+            max_steps = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    try {
+        if (command == "record" && paths.size() == 2) {
+            CoreTraceSource source(paths[0], max_steps, seed);
+            TraceWriter writer(paths[1]);
+            TraceRecord record;
+            while (source.next(record)) {
+                writer.write(record);
+            }
+            if (!writer.close()) {
+                std::cerr << "Error writing " << paths[1] << std::endl;
+                return 2;
+            }
+            return 0;
+        }
+
+        if (command == "diff" && paths.size() == 2) {
+            auto a = open_source(paths[0], max_steps, seed);
+            auto b = open_source(paths[1], max_steps, seed);
+            return diff(*a, *b);
+        }
+
+        if (command == "dump" && paths.size() == 1) {
+            TraceReader reader(paths[0]);
+            TraceRecord record;
+            while (reader.next(record)) {
+                std::cout << format_trace_record(record) << std::endl;
+            }
+            return 0;
+        }
+    } catch(int err) {
+        // load_rom and the trace reader/writer throw 2 for files that can't be opened and 3 for bad trace headers.
+        std::cerr << (err == 3 ? "Not a valid trace file" : "Could not open file") << std::endl;
+        return 2;
+    }
+
+    print_usage();
+    return 2;
+}